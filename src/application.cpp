@@ -7,6 +7,23 @@
 #include <cairo-gobject.h>
 
 #include <math.h>
+// Unix signals and sockets (leftover shmsink socket).
+#include <glib-unix.h>
+#include <glib/gstdio.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Socket path suffix of the result file shared with the server.
+static char const* result_suffix = ".result";
+// Results older than this are not drawn (the server is gone).
+constexpr gint64 result_max_age_us = 2 * G_USEC_PER_SEC;
+// Frames in the shared memory of a capture client.
+constexpr int shm_frames = 8;
+// Seconds between two reconnect attempts of a capture client.
+constexpr guint client_retry_seconds = 1;
 
 //
 // Callback from GstBus
@@ -41,14 +58,71 @@ static void on_bus_message(GstBus * bus, GstMessage * message, gpointer user_dat
   }
 }
 
+//
+// Read the frame geometry from the sample caps (it changes when the caps are renegotiated).
+//
+static bool get_frame_geometry(GstSample* sample, int* width, int* height) {
+  GstVideoInfo info;
+  GstCaps* caps = gst_sample_get_caps(sample);
+  if (caps == nullptr || !gst_video_info_from_caps(&info, caps)) {
+    return false;
+  }
+  *width = GST_VIDEO_INFO_WIDTH(&info);
+  *height = GST_VIDEO_INFO_HEIGHT(&info);
+  return true;
+}
+
+//
+// Quit on SIGINT/SIGTERM so the pipelines stop normally (shmsink removes its socket).
+//
+static gboolean on_quit_signal(gpointer user_data) {
+  Application* app = (Application*)user_data;
+  g_print("Quitting.\n");
+  app->quit();
+  return G_SOURCE_CONTINUE;
+}
+
+//
+// A capture process that crashed leaves its socket file, shmsink would then bind
+// <path>.0 and the server would never find it. Remove the file if nobody listens.
+//
+static void remove_stale_socket(char const* socket_path) {
+  if (!g_file_test(socket_path, G_FILE_TEST_EXISTS)) return;
+
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  g_strlcpy(addr.sun_path, socket_path, sizeof(addr.sun_path));
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) return;
+  bool alive = connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+  close(fd);
+
+  if (alive) {
+    GST_WARNING("Socket %s is in use by another capture process.", socket_path);
+  }
+  else if (g_unlink(socket_path) == 0) {
+    g_print("Removed stale socket %s\n", socket_path);
+  }
+}
+
 //
 // Call back from appsink with new frame for the model.
 //
 static GstFlowReturn onAppSinkNewData(GstElement * element, gpointer user_data) {
   Application* app = (Application*)user_data;
+  gint64 start = g_get_monotonic_time();
  
   GstSample* sample = gst_app_sink_pull_sample(GST_APP_SINK (element));
   GstBuffer* buffer = gst_sample_get_buffer (sample);
+  int width = 0;
+  int height = 0;
+  if (!get_frame_geometry(sample, &width, &height)) {
+    GST_ERROR("onAppSinkNewData invalid caps.");
+    gst_sample_unref(sample);
+    return GST_FLOW_OK;
+  }
 
   int buffers = gst_buffer_n_memory(buffer);
   GST_DEBUG("onAppSinkNewData num buffers %d.", buffers);
@@ -57,13 +131,95 @@ static GstFlowReturn onAppSinkNewData(GstElement * element, gpointer user_data)
     GstMapInfo info;
     if (gst_memory_map (mem, &info, GST_MAP_READ)) {
       GST_DEBUG("Mapped memory %p size %d", info.data, (int) info.size);
-      app->model_.on_new_frame(info.data, (guint) info.size);
+      app->model_.on_new_frame(info.data, (guint) info.size, width, height);
       gst_memory_unmap (mem, &info);
     }
   }
+  gst_sample_unref(sample);
+  // Adaptive mode may have switched to a model with a different input size.
+  app->update_tensor_geometry();
+  app->model_.trace().add("appsink callback", "app", start, g_get_monotonic_time());
+  app->model_.trace().end_frame();
+  return GST_FLOW_OK;
+}
+
+//
+// Call back from a capture client appsink (server mode), the frame is in shared memory.
+//
+static GstFlowReturn on_client_new_data(GstElement * element, gpointer user_data) {
+  CaptureClient* client = (CaptureClient*)user_data;
+  gint64 start = g_get_monotonic_time();
+
+  GstSample* sample = gst_app_sink_pull_sample(GST_APP_SINK (element));
+  GstBuffer* buffer = gst_sample_get_buffer (sample);
+  int frame_width = 0;
+  int frame_height = 0;
+
+  GstMapInfo info;
+  if (get_frame_geometry(sample, &frame_width, &frame_height) && gst_buffer_map (buffer, &info, GST_MAP_READ)) {
+    // shmsink sends no caps, the size is the only check that the client uses the same --size.
+    if (info.size != (gsize)(frame_width * frame_height * 4)) {
+      if (!client->warned_size) {
+        GST_ERROR("Client %s frame is %d bytes, expected %dx%d RGBx (check --size).",
+            client->socket_path.c_str(), (int)info.size, frame_width, frame_height);
+        client->warned_size = true;
+      }
+    }
+    else {
+      std::string label;
+      std::vector<uint8_t> overlay;
+      int width = 0;
+      if (client->app->model_.on_new_frame(info.data, (guint) info.size, frame_width, frame_height, &label, &overlay, &width)) {
+        client->result.write(label, overlay, width);
+      }
+    }
+    gst_buffer_unmap (buffer, &info);
+  }
+  gst_sample_unref(sample);
+  client->app->model_.trace().add("appsink callback", "app", start, g_get_monotonic_time());
+  client->app->model_.trace().end_frame();
   return GST_FLOW_OK;
 }
 
+//
+// Retry to start a capture client.
+//
+static gboolean on_client_retry(gpointer user_data) {
+  CaptureClient* client = (CaptureClient*)user_data;
+  client->retry_id = 0;
+  client->app->start_client(client);
+  return G_SOURCE_REMOVE;
+}
+
+//
+// Callback from a capture client GstBus, the client is restarted instead of quitting.
+//
+static void on_client_bus_message(GstBus * bus, GstMessage * message, gpointer user_data) {
+  CaptureClient* client = (CaptureClient*)user_data;
+  switch (GST_MESSAGE_TYPE (message)) {
+    case GST_MESSAGE_EOS:
+    case GST_MESSAGE_ERROR: {
+      if (GST_MESSAGE_TYPE (message) == GST_MESSAGE_ERROR) {
+        gchar* debug = nullptr;
+        GError* error = nullptr;
+        gst_message_parse_error(message, &error, &debug);
+        GST_WARNING("Client %s: %s - %s", client->socket_path.c_str(), error->message, debug);
+        g_error_free(error);
+        g_free(debug);
+      }
+      gst_element_set_state(client->pipeline.get(), GST_STATE_NULL);
+      client->app->set_client_connected(client, false);
+      if (client->retry_id == 0) {
+        g_print("Capture client %s disconnected, waiting for it.\n", client->socket_path.c_str());
+        client->retry_id = g_timeout_add_seconds(client_retry_seconds, on_client_retry, client);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
 //
 // Store the information from the caps that we are interested in. 
 //
@@ -83,7 +239,9 @@ static void on_draw_overlay(GstElement * overlay, cairo_t * cr, guint64 timestam
   int w = 0;
   // Get overlay frame and width from the model.
   // This is a copy.
-  auto frame = app->model_.get_overlay(&w);
+  std::string label;
+  std::vector<uint8_t> frame;
+  app->get_result(&label, &frame, &w);
   int h = w;
   uint32_t* data = nullptr;
 
@@ -97,7 +255,6 @@ static void on_draw_overlay(GstElement * overlay, cairo_t * cr, guint64 timestam
       CAIRO_FONT_WEIGHT_BOLD);
   cairo_set_font_size(cr, 32);
   cairo_move_to(cr, 30, 30);
-  std::string label = app->model_.get_label();
   cairo_text_path(cr, label.empty() ? " - " :  label.c_str());
   // Render black border
   cairo_fill_preserve(cr);
@@ -142,13 +299,107 @@ static void on_draw_overlay(GstElement * overlay, cairo_t * cr, guint64 timestam
   if (data != nullptr) free(data);
 }
 
+//
+// Periodically report the cascade stats.
+//
+static gboolean on_stats_timer(gpointer user_data) {
+  Application* app = (Application*)user_data;
+  app->model_.print_stats();
+  return G_SOURCE_CONTINUE;
+}
+
 
-bool Application::setup(char const* device, char const* model, char const* label, char const* tensor_name, int channel) {
+bool Application::setup(char const* device, char const* model, char const* label, char const* tensor_name, int channel,
+                        float min_score, float min_margin) {
+  mode_ = Mode::Standalone;
 
-  if (!model_.load(model, label, tensor_name, channel)) {
+  if (!model_.load(model, label, tensor_name, channel, min_score, min_margin)) {
     return false;
   }
 
+  // The frames for the model have the geometry of its input tensor.
+  model_.get_input_geometry(&tensor_width_, &tensor_height_);
+  if (!setup_pipeline(device, tensor_width_, tensor_height_, "appsink name=tensor_sink")) {
+    return false;
+  }
+  start_stats_timer();
+  return true;
+}
+
+bool Application::setup_capture(char const* device, char const* socket_path, int size) {
+  mode_ = Mode::Capture;
+
+  std::string result_path = std::string(socket_path) + result_suffix;
+  if (!result_.open(result_path.c_str())) {
+    return false;
+  }
+
+  remove_stale_socket(socket_path);
+
+  // Frames are written in shared memory, don't wait for the server and drop if it is too slow.
+  char* sink = g_strdup_printf("shmsink socket-path=%s shm-size=%d wait-for-connection=false sync=false",
+      socket_path, size * size * 4 * shm_frames);
+  bool res = setup_pipeline(device, size, size, sink);
+  g_free(sink);
+  return res;
+}
+
+bool Application::setup_server(char const* const* socket_paths, int size, char const* model, char const* label, char const* tensor_name, int channel,
+                               float min_score, float min_margin) {
+  mode_ = Mode::Server;
+
+  if (!model_.load(model, label, tensor_name, channel, min_score, min_margin)) {
+    return false;
+  }
+
+  for (char const* const* path = socket_paths; *path != nullptr; path++) {
+    std::unique_ptr<CaptureClient> client(new CaptureClient());
+    client->app = this;
+    client->socket_path = *path;
+
+    std::string result_path = client->socket_path + result_suffix;
+    if (!client->result.open(result_path.c_str())) {
+      return false;
+    }
+
+    //
+    // One pipeline for client, frames stay in shared memory until the model reads them.
+    //
+    // shmsrc -> queue (leaky) -> appsink
+    //
+    char* pipeline = g_strdup_printf("shmsrc socket-path=%s is-live=true do-timestamp=true ! "
+        "video/x-raw,format=RGBx,width=%d,height=%d ! queue leaky=2 max-size-buffers=2 ! "
+        "appsink name=tensor_sink emit-signals=true sync=false", *path, size, size);
+    g_print("Creating client pipeline from string: %s\n", pipeline);
+    client->pipeline.reset(gst_parse_launch(pipeline, NULL));
+    g_free(pipeline);
+
+    if (client->pipeline.get() == nullptr) {
+      GST_ERROR("Failed to allocate client pipeline.");
+      return false;
+    }
+
+    client->bus.reset(gst_element_get_bus(client->pipeline.get()));
+    gst_bus_add_signal_watch (client->bus.get());
+    g_signal_connect(client->bus.get(), "message", (GCallback) on_client_bus_message, client.get());
+
+    GstElement* element = gst_bin_get_by_name(GST_BIN(client->pipeline.get()), "tensor_sink");
+    if (element != nullptr) {
+      g_signal_connect(element, "new-sample", (GCallback)on_client_new_data, client.get());
+      gst_object_unref(element);
+    }
+    clients_.push_back(std::move(client));
+  }
+
+  if (clients_.empty()) {
+    GST_ERROR("No capture client.");
+    return false;
+  }
+  start_stats_timer();
+  return true;
+}
+
+bool Application::setup_pipeline(char const* device, int width, int height, char const* sink) {
   // TODO: cross-platform you can switch v4l2src to othe elemenet for supporting windows and macosx.
 
   //
@@ -158,14 +409,14 @@ bool Application::setup(char const* device, char const* model, char const* label
   //
   //    tee -> queue -> videoconvert  cairooverlay -> ximagesink (render window)
   //    |
-  //    -> queue ->videoscale (224x224) -> appsink (app sink push frames to the model)
+  //    -> queue ->videoscale (model input, e.g. 224x224) -> appsink (app sink push frames to the model) or shmsink (capture mode)
   //
   char* pipeline = g_strdup_printf("v4l2src device=%s ! videoconvert ! videoscale ! "
       "video/x-raw,width=1280,height=720,format=RGBx ! videocrop top=0 left=280 right=280 bottom=0 ! tee name=t_raw "
       "t_raw. ! queue ! videoconvert ! cairooverlay name=tensor_overlay ! "
       " ximagesink name=img_tensor "
-      "t_raw. ! queue leaky=2 max-size-buffers=2 ! videoscale ! video/x-raw,width=224,height=224 !"
-      "appsink name=tensor_sink", device);
+      "t_raw. ! queue leaky=2 max-size-buffers=2 ! videoscale ! capsfilter name=tensor_caps caps=video/x-raw,width=%d,height=%d !"
+      "%s", device, width, height, sink);
 
   g_print("Creating pipeline from string: %s\n", pipeline);
 
@@ -200,17 +451,120 @@ bool Application::setup(char const* device, char const* model, char const* label
   return true;
 }
 
-void Application::run() {
-  // set pipeline in start state.
-  auto res = gst_element_set_state(pipeline_.get(), GST_STATE_PLAYING);
+void Application::start_client(CaptureClient* client) {
+  // shmsrc fails to start until the capture client socket exists.
+  auto res = gst_element_set_state(client->pipeline.get(), GST_STATE_PLAYING);
   if (res == GST_STATE_CHANGE_FAILURE) {
-    g_print("Failed to start gstreamer pipeline. Run with GST_DEBUG=3");
+    gst_element_set_state(client->pipeline.get(), GST_STATE_NULL);
+    if (client->retry_id == 0) {
+      client->retry_id = g_timeout_add_seconds(client_retry_seconds, on_client_retry, client);
+    }
     return;
   }
-  // run main loop. It will block until main loop quits.
-  g_main_loop_run(mainloop_.get());
-  // set pipline in stop (NULL) state.
-  gst_element_set_state(pipeline_.get(), GST_STATE_NULL);
+  g_print("Capture client %s connected.\n", client->socket_path.c_str());
+  set_client_connected(client, true);
+}
+
+void Application::set_client_connected(CaptureClient* client, bool connected) {
+  if (client->connected == connected) return;
+  client->connected = connected;
+  if (connected) client->warned_size = false;
+
+  int count = 0;
+  for (auto const& c : clients_) {
+    if (c->connected) count++;
+  }
+  model_.set_streams(count);
+}
+
+void Application::set_adaptive(float target_fps) {
+  model_.set_adaptive(target_fps);
+  update_tensor_geometry();
+  start_stats_timer();
+}
+
+void Application::start_stats_timer() {
+  // Report escalation rate and per-stage timing, a single model has nothing to report.
+  if (timer_id_ == 0 && model_.has_stats()) {
+    timer_id_ = g_timeout_add_seconds(10, on_stats_timer, this);
+  }
+}
+
+void Application::update_tensor_geometry() {
+  // Client frames have the size chosen by the capture process.
+  if (mode_ != Mode::Standalone || pipeline_.get() == nullptr) return;
+
+  int width = 0;
+  int height = 0;
+  model_.get_input_geometry(&width, &height);
+  if (width == tensor_width_ && height == tensor_height_) return;
+
+  GstElement* element = gst_bin_get_by_name(GST_BIN(pipeline_.get()), "tensor_caps");
+  if (element != nullptr) {
+    // capsfilter asks upstream to reconfigure, videoscale then produces the new size.
+    GstCaps* caps = gst_caps_new_simple("video/x-raw", "width", G_TYPE_INT, width, "height", G_TYPE_INT, height, NULL);
+    g_object_set(element, "caps", caps, NULL);
+    gst_caps_unref(caps);
+    gst_object_unref(element);
+    g_print("Model input geometry %dx%d\n", width, height);
+  }
+  tensor_width_ = width;
+  tensor_height_ = height;
+}
+
+void Application::get_result(std::string* label, std::vector<uint8_t>* overlay, int* width) {
+  if (mode_ == Mode::Capture) {
+    if (!result_.read(label, overlay, width, result_max_age_us)) {
+      label->clear();
+      overlay->clear();
+      *width = 0;
+    }
+    return;
+  }
+  *label = model_.get_label();
+  *overlay = model_.get_overlay(width);
+}
+
+void Application::run() {
+  guint sigint_id = g_unix_signal_add(SIGINT, on_quit_signal, this);
+  guint sigterm_id = g_unix_signal_add(SIGTERM, on_quit_signal, this);
+
+  if (mode_ == Mode::Server) {
+    // Clients are started (and restarted) independently.
+    for (auto& client : clients_) {
+      start_client(client.get());
+    }
+    g_main_loop_run(mainloop_.get());
+    for (auto& client : clients_) {
+      if (client->retry_id != 0) {
+        g_source_remove(client->retry_id);
+        client->retry_id = 0;
+      }
+      gst_element_set_state(client->pipeline.get(), GST_STATE_NULL);
+    }
+  }
+  else {
+    // set pipeline in start state.
+    auto res = gst_element_set_state(pipeline_.get(), GST_STATE_PLAYING);
+    if (res == GST_STATE_CHANGE_FAILURE) {
+      g_print("Failed to start gstreamer pipeline. Run with GST_DEBUG=3");
+      g_source_remove(sigint_id);
+      g_source_remove(sigterm_id);
+      return;
+    }
+    // run main loop. It will block until main loop quits.
+    g_main_loop_run(mainloop_.get());
+    // set pipline in stop (NULL) state.
+    gst_element_set_state(pipeline_.get(), GST_STATE_NULL);
+  }
+  g_source_remove(sigint_id);
+  g_source_remove(sigterm_id);
+  if (timer_id_ != 0) {
+    g_source_remove(timer_id_);
+    timer_id_ = 0;
+  }
+  // Write what is left in the profiling window (also on SIGINT/SIGTERM, they quit the main loop).
+  model_.trace().flush();
 }
 
 void Application::quit() {
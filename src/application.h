@@ -6,8 +6,33 @@
 #include <gst/video/video.h>
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "model.h"
+#include "shared_result.h"
+
+class Application;
+
+/**
+ * @brief A capture client attached to the inference server.
+ * 
+ * Each client has its own pipeline (shmsrc -> appsink) so it can come and go
+ * without stopping the other clients.
+ */
+struct CaptureClient {
+  Application* app = nullptr;
+  std::string socket_path;
+  std::unique_ptr<GstElement, decltype(&gst_object_unref)> pipeline{nullptr, &gst_object_unref};
+  std::unique_ptr<GstBus, decltype(&gst_object_unref)> bus{nullptr, &gst_object_unref};
+  // Reconnect timer.
+  guint retry_id = 0;
+  bool connected = false;
+  // Frame size mismatch already logged (since the last connection).
+  bool warned_size = false;
+  // Results sent back to the client.
+  SharedResult result;
+};
 
 /**
  * @brief Application
@@ -18,9 +43,23 @@
  * - Run gstreamer pipeline
  * - Host callback from gstreamer.
  * - Retain the model and load the model.
+ * 
+ * It runs in one of three modes:
+ * 
+ * - Standalone: capture, display and inference in this process.
+ * - Capture: capture and display, frames are published on a shared memory socket (shmsink) and
+ *   results are read back from a shared result file.
+ * - Server: inference only, frames are consumed from many capture clients (shmsrc).
  */
 class Application {
 public:
+  enum class Mode {
+    Standalone,
+    Capture,
+    Server
+  };
+
+  Mode mode_ = Mode::Standalone;
   // Main loop.
   std::unique_ptr<GMainLoop, decltype(&g_main_loop_unref)> mainloop_;
   // Bus watcher.
@@ -34,6 +73,13 @@ public:
   std::unique_ptr<GstElement, decltype(&gst_object_unref)> pipeline_;
   // Model 
   Model model_;
+  // Capture mode: results from the server.
+  SharedResult result_;
+  // Server mode: the capture clients.
+  std::vector<std::unique_ptr<CaptureClient>> clients_;
+  // Geometry of the frames for the model (appsink caps).
+  int tensor_width_ = 0;
+  int tensor_height_ = 0;
 
 public:
   /**
@@ -50,7 +96,33 @@ public:
    * 
    * @return true if setup is correct otherwise false.
    */
-  bool setup(char const* device, char const* model, char const* label, char const* tensor_name, int channel);
+  bool setup(char const* device, char const* model, char const* label, char const* tensor_name, int channel,
+             float min_score, float min_margin);
+
+  /**
+   * @brief Setup the application in capture mode.
+   * 
+   * @param socket_path shmsink socket, results are read from socket_path + ".result".
+   * @param size published frames are size x size.
+   * @return true if setup is correct otherwise false.
+   */
+  bool setup_capture(char const* device, char const* socket_path, int size);
+
+  /**
+   * @brief Setup the application in server mode.
+   * 
+   * @param socket_paths nullptr terminated list of capture client sockets.
+   * @param size frames from the clients are size x size.
+   * @return true if setup is correct otherwise false.
+   */
+  bool setup_server(char const* const* socket_paths, int size, char const* model, char const* label, char const* tensor_name, int channel,
+                    float min_score, float min_margin);
+
+  /**
+   * @brief Enable adaptive mode (switch model from the measured latency), call after setup.
+   * 
+   */
+  void set_adaptive(float target_fps);
 
   /**
    * @brief Run the main loop.
@@ -62,6 +134,34 @@ public:
    * 
    */
   void quit();
+
+  /**
+   * @brief Get the label and the overlay to draw, from the model or from the server.
+   * 
+   */
+  void get_result(std::string* label, std::vector<uint8_t>* overlay, int* width);
+
+  /**
+   * @brief (Re)start a capture client pipeline, on failure it retries later.
+   * 
+   */
+  void start_client(CaptureClient* client);
+
+  /**
+   * @brief Track connected clients, in adaptive mode the model budget is shared between them.
+   * 
+   */
+  void set_client_connected(CaptureClient* client, bool connected);
+
+  /**
+   * @brief Renegotiate the appsink caps if the model wants a different geometry.
+   * 
+   */
+  void update_tensor_geometry();
+
+private:
+  void start_stats_timer();
+  bool setup_pipeline(char const* device, int width, int height, char const* sink);
 };
 
 #endif
\ No newline at end of file
@@ -14,14 +14,32 @@ static char* model = nullptr;
 static char* label = nullptr;
 static char* tensor_name = nullptr;
 static int channel = 0;
+static double threshold = 0.6;
+static double margin = 0.2;
+static char* mode = nullptr;
+static char** sockets = nullptr;
+static int size = 224;
+static gboolean adaptive = FALSE;
+static double fps = 30.0;
+static char* profile = nullptr;
+static int profile_window = 300;
 
 static GOptionEntry entries[] =
 {
   { "device", 'd', 0, G_OPTION_ARG_STRING, &device, "device path", "/dev/video0" },
-  { "model", 'm', 0, G_OPTION_ARG_STRING, &model, "model path", "mobilenet/mobilenet_v1_1.0_224_quant.tflite" },
+  { "model", 'm', 0, G_OPTION_ARG_STRING, &model, "model path (comma separated for a cascade, cheapest first)", "mobilenet/mobilenet_v1_1.0_224_quant.tflite" },
   { "label", 'l', 0, G_OPTION_ARG_STRING, &label, "label path", "mobilenet/labels.txt" },
   { "tensor", 't', 0, G_OPTION_ARG_STRING, &tensor_name, "tensor name for overlay", nullptr },
   { "channel", 'c', 0, G_OPTION_ARG_INT, &channel, "tensor channel for overlay", "0" },
+  { "threshold", 's', 0, G_OPTION_ARG_DOUBLE, &threshold, "cascade escalates when top-1 score is under threshold", "0.6" },
+  { "margin", 'g', 0, G_OPTION_ARG_DOUBLE, &margin, "cascade escalates when top-1 minus top-2 is under margin", "0.2" },
+  { "mode", 'M', 0, G_OPTION_ARG_STRING, &mode, "standalone, capture (publish frames) or server (inference for capture clients)", "standalone" },
+  { "socket", 'S', 0, G_OPTION_ARG_STRING_ARRAY, &sockets, "shared memory socket (repeat in server mode for each client)", "/tmp/rt_image_classification.sock" },
+  { "size", 'z', 0, G_OPTION_ARG_INT, &size, "frame size in shared memory (capture and server modes)", "224" },
+  { "adaptive", 'a', 0, G_OPTION_ARG_NONE, &adaptive, "switch between the models (e.g. 128/160/192/224) to keep the frame rate", nullptr },
+  { "fps", 'f', 0, G_OPTION_ARG_DOUBLE, &fps, "target frame rate for adaptive mode", "30" },
+  { "profile", 'p', 0, G_OPTION_ARG_STRING, &profile, "profile app stages and ops, write a Chrome trace", "trace.json" },
+  { "profile-window", 'w', 0, G_OPTION_ARG_INT, &profile_window, "frames in each profile summary and trace", "300" },
   { nullptr }
 };
 
@@ -44,12 +62,39 @@ int main(int argc, char **argv) {
   if (model == nullptr) model = g_strdup("mobilenet/mobilenet_v1_1.0_224_quant.tflite");
   if (label == nullptr) label = g_strdup("mobilenet/labels.txt");
   if (tensor_name == nullptr) tensor_name = g_strdup("MobilenetV1/MobilenetV1/Conv2d_13_pointwise/Relu6");
-
-  g_print("Starting application with camera device %s\n", device);
+  if (mode == nullptr) mode = g_strdup("standalone");
+  if (sockets == nullptr) {
+    sockets = g_new0(char*, 2);
+    sockets[0] = g_strdup("/tmp/rt_image_classification.sock");
+  }
 
   Application app;
+  bool res = false;
   // Setup application and run.
-  if (app.setup(device, model, label, tensor_name, channel)) {
+  if (!g_strcmp0(mode, "standalone")) {
+    g_print("Starting application with camera device %s\n", device);
+    res = app.setup(device, model, label, tensor_name, channel, (float)threshold, (float)margin);
+  }
+  else if (!g_strcmp0(mode, "capture")) {
+    g_print("Starting capture with camera device %s on socket %s\n", device, sockets[0]);
+    res = app.setup_capture(device, sockets[0], size);
+  }
+  else if (!g_strcmp0(mode, "server")) {
+    g_print("Starting inference server for %d capture clients\n", (int)g_strv_length(sockets));
+    res = app.setup_server(sockets, size, model, label, tensor_name, channel, (float)threshold, (float)margin);
+  }
+  else {
+    g_print("Unknown mode %s\n", mode);
+  }
+
+  if (res && adaptive && app.mode_ != Application::Mode::Capture) {
+    app.set_adaptive((float)fps);
+  }
+  if (res && profile != nullptr && app.mode_ != Application::Mode::Capture) {
+    app.model_.enable_profiling(profile, profile_window);
+  }
+
+  if (res) {
     app.run();
     return EXIT_SUCCESS;
   }
@@ -5,16 +5,14 @@
 #include <fstream>
 #include <sstream>
 #include <queue>
+#include <algorithm>
 // C
 #include <gst/gst.h>
 #include <limits.h>
 
 #include "tensorflow/contrib/lite/optional_debug_tools.h"
+#include "tensorflow/contrib/lite/schema/schema_generated.h"
 
-// These dimensions need to match those the model was trained with.
-constexpr int wanted_input_width = 224;
-constexpr int wanted_input_height = 224;
-constexpr int wanted_input_channels = 3;
 constexpr float input_mean = 128.0f;
 constexpr float input_std = 127.0f;
 const std::string input_layer_name = "input";
@@ -54,7 +52,8 @@ void get_top_N(std::vector<float>& prediction, int num_results, float threshold,
 }
 
 // Preprocess the input image and feed the TFLite interpreter buffer for a float model.
-void process_input_float_model(uint8_t* input, float* buffer, int image_width, int image_height, int image_channels) {
+void process_input_float_model(uint8_t* input, float* buffer, int image_width, int image_height, int image_channels,
+    int wanted_input_width, int wanted_input_height, int wanted_input_channels) {
   for (int y = 0; y < wanted_input_height; ++y) {
     float* out_row = buffer + (y * wanted_input_width * wanted_input_channels);
     for (int x = 0; x < wanted_input_width; ++x) {
@@ -72,7 +71,8 @@ void process_input_float_model(uint8_t* input, float* buffer, int image_width, i
 
 // Preprocess the input image and feed the TFLite interpreter buffer for a quantized model.
 void process_input_quant_model(
-    uint8_t* input, uint8_t* output, int image_width, int image_height, int image_channels) {
+    uint8_t* input, uint8_t* output, int image_width, int image_height, int image_channels,
+    int wanted_input_width, int wanted_input_height, int wanted_input_channels) {
   for (int y = 0; y < wanted_input_height; ++y) {
     uint8_t* out_row = output + (y * wanted_input_width * wanted_input_channels);
     for (int x = 0; x < wanted_input_width; ++x) {
@@ -88,47 +88,79 @@ void process_input_quant_model(
 }
 
 
-bool Model::load(char const* model, char const* label, char const* tensor_name, int channel) {
-  model_path_ = model;
+bool Model::load(char const* models, char const* label, char const* tensor_name, int channel, float min_score, float min_margin) {
+  model_path_ = models;
   label_path_ = label;
   if (tensor_name != nullptr) {
     tensor_name_ = tensor_name;
   }
   channel_ = channel;
+  min_score_ = min_score;
+  min_margin_ = min_margin;
+
+  // Models are separated by comma, cheapest first.
+  stages_.clear();
+  bool res1 = true;
+  gchar** paths = g_strsplit(models, ",", -1);
+  for (gchar** path = paths; *path != nullptr; path++) {
+    if (**path != '\0') {
+      res1 = load_model(*path) && res1;
+    }
+  }
+  g_strfreev(paths);
+  res1 = res1 && !stages_.empty();
 
-  bool res1 = load_model(model);
   bool res2 = load_labels(label);
-  bool res3 = (res1 && res2) ? activate() : false;
+  bool res3 = res1 && res2;
+  for (auto& stage : stages_) {
+    res3 = res3 && activate(stage);
+  }
   g_print("Load model %s and labels %s, activated %s\n", res1 ? "OK" : "FAIL", res2 ? "OK" : "FAIL", res3 ? "OK" : "FAIL");
   return res1 && res2 && res3;
 }
 
 bool Model::load_model(char const* path) {
-  model_ = tflite::FlatBufferModel::BuildFromFile(path);
-  return model_.get() != nullptr;
+  Stage stage;
+  stage.path = path;
+  gchar* name = g_path_get_basename(path);
+  stage.name = name;
+  g_free(name);
+  stage.model = tflite::FlatBufferModel::BuildFromFile(path);
+  if (stage.model.get() == nullptr) {
+    GST_ERROR("Failed to load model %s.", path);
+    return false;
+  }
+  stages_.push_back(std::move(stage));
+  return true;
 }
 
-bool Model::activate() {
+bool Model::activate(Stage& stage) {
   // Build the interpreter
   tflite::ops::builtin::BuiltinOpResolver resolver;
-  tflite::InterpreterBuilder builder(*model_, resolver);
-  builder(&interpreter_);
-  if (interpreter_.get() != nullptr) {
-    // Resize input tensor.
-    int input = interpreter_->inputs()[0];
-    std::vector<int> sizes = {1, 224, 224, 3};
-    interpreter_->ResizeInputTensor(input, sizes);
+  tflite::InterpreterBuilder builder(*stage.model, resolver);
+  builder(&stage.interpreter);
+  if (stage.interpreter.get() != nullptr) {
+    // Each model keeps the input geometry it was trained with (NHWC).
+    int input = stage.interpreter->inputs()[0];
+    TfLiteIntArray* dims = stage.interpreter->tensor(input)->dims;
+    if (dims->size != 4) {
+      GST_ERROR("Unexpected input dims size %d for model %s.", dims->size, stage.path.c_str());
+      return false;
+    }
+    stage.height = dims->data[1];
+    stage.width = dims->data[2];
+    stage.channels = dims->data[3];
     // Allocate tensor buffers.
-    interpreter_->AllocateTensors();
-    tflite::PrintInterpreterState(interpreter_.get());
+    stage.interpreter->AllocateTensors();
+    tflite::PrintInterpreterState(stage.interpreter.get());
 
     int idx = 0;
-    auto outs = interpreter_->outputs();
+    auto outs = stage.interpreter->outputs();
     for (auto& o : outs) {
-      g_print("%d: Output %d %s\n", idx, o, interpreter_->GetOutputName(idx));
+      g_print("%d: Output %d %s\n", idx, o, stage.interpreter->GetOutputName(idx));
       idx++;
     }
-
+    g_print("Model %s input %dx%dx%d\n", stage.path.c_str(), stage.width, stage.height, stage.channels);
 
     return true;
   }
@@ -166,11 +198,15 @@ bool Model::load_labels(char const* path) {
 }
 
 std::string Model::get_label(){
-  if (index_ >= 0 && index_ < (int)labels_.size()) {
+  return format_label(index_, acc_);
+}
+
+std::string Model::format_label(int index, float acc) {
+  if (index >= 0 && index < (int)labels_.size()) {
     std::ostringstream out;
-    out << labels_[index_] << " - ";
+    out << labels_[index] << " - ";
     out.precision(2);
-    out << std::fixed << acc_;
+    out << std::fixed << acc;
     return out.str();
   }
   return "";
@@ -183,77 +219,328 @@ std::vector<uint8_t> Model::get_overlay(int* width) {
 }
 
 
-void Model::on_new_frame(guint8 * buffer, guint len) {
-  if (buffer == nullptr) return;
+void Model::print_stats() {
+  std::lock_guard<std::mutex> guard(statsMtx_);
+  guint64 total = 0;
+  for (auto const& stage : stages_) {
+    total += stage.frames;
+  }
+  if (total == 0) return;
+
+  if (adaptive_) {
+    g_print("Adaptive: active %s, %" G_GUINT64_FORMAT " switches\n", stages_[active_].path.c_str(), switches_);
+    switches_ = 0;
+  }
+  else {
+    guint64 frames = stages_[0].frames;
+    guint64 escalated = stages_.back().frames;
+    g_print("Cascade: %" G_GUINT64_FORMAT " frames, escalation rate to last stage %.1f%%\n",
+        frames, stages_.size() > 1 ? (100.0 * escalated / frames) : 0.0);
+  }
+  for (size_t i = 0; i < stages_.size(); i++) {
+    Stage& stage = stages_[i];
+    g_print("  stage %d %s (%dx%d): %" G_GUINT64_FORMAT " frames, avg %.2f ms, escalated %" G_GUINT64_FORMAT "\n",
+        (int)i, stage.path.c_str(), stage.width, stage.height, stage.frames,
+        stage.frames > 0 ? (stage.total_us / 1000.0 / stage.frames) : 0.0, stage.escalated);
+    stage.frames = 0;
+    stage.escalated = 0;
+    stage.total_us = 0;
+  }
+}
+
+
+void Model::set_adaptive(float target_fps) {
+  std::lock_guard<std::mutex> guard(inferenceMtx_);
+  adaptive_ = target_fps > 0.0f && !stages_.empty();
+  if (!adaptive_) return;
+
+  target_fps_ = target_fps;
+  frame_budget_us_ = G_USEC_PER_SEC / (target_fps_ * streams_);
+  std::sort(stages_.begin(), stages_.end(), [](Stage const& a, Stage const& b) {
+    return a.width * a.height < b.width * b.height;
+  });
+  active_ = (int)stages_.size() - 1;
+  frames_since_switch_ = 0;
+  g_print("Adaptive mode: %d models, target %.1f fps (%.2f ms)\n", (int)stages_.size(), target_fps, frame_budget_us_ / 1000.0);
+}
+
+void Model::set_streams(int streams) {
+  std::lock_guard<std::mutex> guard(inferenceMtx_);
+  streams_ = std::max(1, streams);
+  if (adaptive_) {
+    frame_budget_us_ = G_USEC_PER_SEC / (target_fps_ * streams_);
+    g_print("Adaptive mode: %d streams, budget %.2f ms\n", streams_, frame_budget_us_ / 1000.0);
+  }
+}
+
+void Model::get_input_geometry(int* width, int* height) {
+  int w = 0;
+  int h = 0;
+  if (adaptive_) {
+    Stage const& stage = stages_[active_];
+    w = stage.width;
+    h = stage.height;
+  }
+  else {
+    for (auto const& stage : stages_) {
+      w = std::max(w, stage.width);
+      h = std::max(h, stage.height);
+    }
+  }
+  if (width != nullptr) *width = w;
+  if (height != nullptr) *height = h;
+}
+
+void Model::adapt(gint64 latency_us) {
+  // Latency must stay under the frame budget, switch only after the average settled.
+  constexpr double latency_smoothing = 0.1;
+  constexpr int frames_before_switch = 30;
+  constexpr double up_headroom = 0.8;
+  // The last measure of a bigger model expires, the load that made us step down may be gone.
+  constexpr int frames_before_expire = 300;
+
+  int active = active_;
+  Stage& stage = stages_[active];
+  stage.latency_frame = ++adaptive_frames_;
+  if (frames_since_switch_ == 0 || stage.latency_us <= 0.0) {
+    stage.latency_us = latency_us;
+  }
+  else {
+    stage.latency_us += latency_smoothing * (latency_us - stage.latency_us);
+  }
+  if (++frames_since_switch_ < frames_before_switch) {
+    return;
+  }
+
+  int next = active;
+  if (stage.latency_us > frame_budget_us_ && active > 0) {
+    next = active - 1;
+  }
+  else if (active + 1 < (int)stages_.size()) {
+    // Use the last measure of the bigger model while fresh, or scale ours with the number of pixels.
+    Stage const& bigger = stages_[active + 1];
+    bool fresh = bigger.latency_us > 0.0 && (adaptive_frames_ - bigger.latency_frame) < (guint64)frames_before_expire;
+    double predicted_us = fresh ? bigger.latency_us :
+        stage.latency_us * (bigger.width * bigger.height) / (double)(stage.width * stage.height);
+    if (predicted_us < up_headroom * frame_budget_us_) {
+      next = active + 1;
+    }
+  }
+
+  if (next != active) {
+    g_print("Adaptive mode: %.2f ms, switch to %s (%dx%d)\n", stage.latency_us / 1000.0,
+        stages_[next].path.c_str(), stages_[next].width, stages_[next].height);
+    active_ = next;
+    frames_since_switch_ = 0;
+    std::lock_guard<std::mutex> guard(statsMtx_);
+    switches_++;
+  }
+}
+
+void Model::on_new_frame(guint8 * buffer, guint len, int frame_width, int frame_height) {
+  on_new_frame(buffer, len, frame_width, frame_height, nullptr, nullptr, nullptr);
+}
+
+bool Model::on_new_frame(guint8 * buffer, guint len, int frame_width, int frame_height,
+                         std::string* label, std::vector<uint8_t>* overlay, int* width) {
+  if (buffer == nullptr || stages_.empty()) return false;
+
+  std::lock_guard<std::mutex> guard(inferenceMtx_);
 
-  constexpr int image_width = 224;
-  constexpr int image_height = 224;
   constexpr int image_channels = 4;
+  if (frame_width <= 0 || frame_height <= 0 || len < (guint)(frame_width * frame_height * image_channels)) {
+    GST_ERROR("Frame too small %u (%dx%d).", len, frame_width, frame_height);
+    return false;
+  }
+
+  // Result of this frame (clients must not get the result of another client frame).
+  int index = -1;
+  float acc = 0.0f;
+  std::vector<uint8_t> frame_overlay;
+  int frame_overlay_width = 0;
+
+  if (adaptive_) {
+    gint64 start = g_get_monotonic_time();
+    run_stage(stages_[active_], buffer, frame_width, frame_height, image_channels, true,
+        &index, &acc, &frame_overlay, &frame_overlay_width);
+    adapt(g_get_monotonic_time() - start);
+  }
+  else {
+    // Go through the cascade until a stage is confident enough.
+    for (size_t i = 0; i < stages_.size(); i++) {
+      if (run_stage(stages_[i], buffer, frame_width, frame_height, image_channels, i + 1 == stages_.size(),
+          &index, &acc, &frame_overlay, &frame_overlay_width)) {
+        break;
+      }
+    }
+  }
+
+  // Set the label 
+  index_ = index;
+  acc_ = acc;
+  if (label != nullptr) *label = format_label(index, acc);
+  if (overlay != nullptr) *overlay = frame_overlay;
+  if (width != nullptr) *width = frame_overlay_width;
+
+  std::lock_guard<std::mutex> overlay_guard(overlayMtx_);
+  overlayFrame_.swap(frame_overlay);
+  overlayFrameWidth_ = frame_overlay_width;
+  return true;
+}
 
-  int input = interpreter_->inputs()[0];
-  TfLiteTensor *input_tensor = interpreter_->tensor(input);
+bool Model::run_stage(Stage& stage, guint8* buffer, int image_width, int image_height, int image_channels, bool last,
+                      int* index, float* acc, std::vector<uint8_t>* overlay, int* overlay_width) {
+  tflite::Interpreter* interpreter = stage.interpreter.get();
+  gint64 start = g_get_monotonic_time();
+  // Name the spans with the model only when there is more than one.
+  bool profiling = trace_.enabled();
+  std::string prefix = (profiling && stages_.size() > 1) ? stage.name + " " : "";
+
+  int input = interpreter->inputs()[0];
+  TfLiteTensor *input_tensor = interpreter->tensor(input);
 
   bool is_quantized = (input_tensor->type == kTfLiteUInt8);
 
   if (is_quantized) {
-    uint8_t* out = interpreter_->typed_tensor<uint8_t>(input);
-    process_input_quant_model(buffer, out, image_width, image_height, image_channels);
+    uint8_t* out = interpreter->typed_tensor<uint8_t>(input);
+    process_input_quant_model(buffer, out, image_width, image_height, image_channels,
+        stage.width, stage.height, stage.channels);
   } 
   else {
-    float* out = interpreter_->typed_tensor<float>(input);
-    process_input_float_model(buffer, out, image_width, image_height, image_channels);
+    float* out = interpreter->typed_tensor<float>(input);
+    process_input_float_model(buffer, out, image_width, image_height, image_channels,
+        stage.width, stage.height, stage.channels);
   }
 
-  if (interpreter_->Invoke() != kTfLiteOk) {
-    GST_ERROR("Failed to invoke!");
+  gint64 invoke_start = g_get_monotonic_time();
+  if (profiling) {
+    trace_.add((prefix + "preprocess").c_str(), "model", start, invoke_start);
+    if (stage.profiler) stage.profiler->StartProfiling();
+  }
+  if (interpreter->Invoke() != kTfLiteOk) {
+    GST_ERROR("Failed to invoke %s!", stage.path.c_str());
+  }
+  gint64 invoke_end = g_get_monotonic_time();
+  if (profiling) {
+    trace_.add((prefix + "invoke").c_str(), "model", invoke_start, invoke_end);
+    if (stage.profiler) {
+      stage.profiler->StopProfiling();
+      add_op_events(stage, prefix, invoke_start);
+    }
   }
 
   // read output size from the output sensor
-  auto outs = interpreter_->outputs();
+  auto outs = interpreter->outputs();
   int reshapeIndex = 0;
   int intIndex = -1;
   for (size_t i = 0; i < outs.size(); i++) {
-    if (!g_strcmp0(interpreter_->GetOutputName(i), "MobilenetV1/Predictions/Reshape_1")) {
+    if (!g_strcmp0(interpreter->GetOutputName(i), "MobilenetV1/Predictions/Reshape_1")) {
       reshapeIndex = (int)i;
     }
-    if (!g_strcmp0(interpreter_->GetOutputName(i), tensor_name_.c_str())) {
+    if (!g_strcmp0(interpreter->GetOutputName(i), tensor_name_.c_str())) {
       intIndex = (int)i;
     }
   }
 
-  auto output = get_tensor_output_2dim(reshapeIndex);
+  auto output = get_tensor_output_2dim(interpreter, reshapeIndex);
   std::vector<std::pair<float, int> > top_results;
   get_top_N(output, 5, 0.1, &top_results);
-  // Set the label 
-  for (size_t i = 0; i < top_results.size(); i++) {
-    auto el = top_results[i];
-    //g_print("Result %f %d - %s\n", el.first, el.second, labels_[el.second].c_str());
-    index_ = el.second;
-    acc_ = el.first;
+
+  float top1 = top_results.size() > 0 ? top_results[0].first : 0.0f;
+  float top2 = top_results.size() > 1 ? top_results[1].first : 0.0f;
+  bool confident = top1 >= min_score_ && (top1 - top2) >= min_margin_;
+  if (profiling) {
+    trace_.add((prefix + "top_k").c_str(), "model", invoke_end, g_get_monotonic_time());
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(statsMtx_);
+    stage.frames++;
+    stage.total_us += g_get_monotonic_time() - start;
+    if (!confident && !last) stage.escalated++;
   }
 
-  // TODO: 
+  if (!confident && !last) {
+    return false;
+  }
+
+  *index = top_results.empty() ? -1 : top_results[0].second;
+  *acc = top_results.empty() ? 0.0f : top_results[0].first;
+
+  // A stage without the tensor gives no overlay, an older heat map is not current.
+  overlay->clear();
+  *overlay_width = 0;
   if (intIndex >= 0) {
-    std::lock_guard<std::mutex> guard(overlayMtx_);
-    overlayFrame_ = get_tensor_output_mat_quant(intIndex, channel_, &overlayFrameWidth_);
+    gint64 overlay_start = g_get_monotonic_time();
+    *overlay = get_tensor_output_mat_quant(interpreter, intIndex, channel_, overlay_width);
+    if (profiling) {
+      trace_.add((prefix + "overlay").c_str(), "model", overlay_start, g_get_monotonic_time());
+    }
   }
 
-  return;
+  return true;
 }
 
+void Model::enable_profiling(char const* trace_path, int window_frames) {
+  std::lock_guard<std::mutex> guard(inferenceMtx_);
+#ifdef TFLITE_PROFILING_ENABLED
+  for (auto& stage : stages_) {
+    stage.profiler.reset(new tflite::profiling::Profiler());
+    stage.interpreter->SetProfiler(stage.profiler.get());
+  }
+#else
+  // Without the define Profiler is the empty noop class, a tensorflow-lite built with
+  // profiling would write its events in it. Only the app stages are recorded.
+  g_print("Built without TFLITE_PROFILING_ENABLED, profiling app stages only.\n");
+#endif
+  trace_.enable(trace_path, window_frames);
+}
 
-std::vector<float> Model::get_tensor_output_2dim(int idx) {
-  std::vector<float> result;
-  int input = interpreter_->inputs()[0];
-  TfLiteTensor *input_tensor = interpreter_->tensor(input);
-  bool is_quantized = false;
-  if (input_tensor->type == kTfLiteUInt8) {
-    is_quantized = true;
+void Model::add_op_events(Stage& stage, std::string const& prefix, gint64 invoke_start_us) {
+  tflite::Interpreter* interpreter = stage.interpreter.get();
+  auto events = stage.profiler->GetProfileEvents();
+  if (events.empty()) {
+    if (!warnedNoOpEvents_) {
+      g_print("No op-level events, tensorflow-lite must be built with TFLITE_PROFILING_ENABLED too.\n");
+      warnedNoOpEvents_ = true;
+    }
+    return;
+  }
+
+  uint64_t first_us = events[0]->begin_timestamp_us;
+  for (auto event : events) {
+    first_us = std::min(first_us, event->begin_timestamp_us);
   }
 
+  for (auto event : events) {
+    if (event->event_type != tflite::profiling::ProfileEvent::EventType::OPERATOR_INVOKE_EVENT) {
+      continue;
+    }
+    auto node_and_registration = interpreter->node_and_registration((int)event->event_metadata);
+    if (node_and_registration == nullptr) {
+      continue;
+    }
+    TfLiteNode const& node = node_and_registration->first;
+    TfLiteRegistration const& registration = node_and_registration->second;
+    char const* op = registration.custom_name != nullptr ? registration.custom_name :
+        tflite::EnumNameBuiltinOperator((tflite::BuiltinOperator)registration.builtin_code);
+    // The layer is named after its first output tensor (e.g. MobilenetV1/MobilenetV1/Conv2d_1_depthwise/Relu6).
+    char const* layer = node.outputs->size > 0 ? interpreter->tensor(node.outputs->data[0])->name : op;
+    gint64 start = invoke_start_us + (gint64)(event->begin_timestamp_us - first_us);
+    gint64 end = invoke_start_us + (gint64)(event->end_timestamp_us - first_us);
+    trace_.add((prefix + layer).c_str(), "op", start, end, op);
+  }
+  stage.profiler->Reset();
+}
+
+
+std::vector<float> Model::get_tensor_output_2dim(tflite::Interpreter* interpreter, int idx) {
+  std::vector<float> result;
+
     // Reshape get result
-  const int output_tensor_index = interpreter_->outputs()[idx];
-  TfLiteTensor* output_tensor = interpreter_->tensor(output_tensor_index);
+  const int output_tensor_index = interpreter->outputs()[idx];
+  TfLiteTensor* output_tensor = interpreter->tensor(output_tensor_index);
+  bool is_quantized = (output_tensor->type == kTfLiteUInt8);
   TfLiteIntArray* output_dims = output_tensor->dims;
   int output_size = output_dims->data[1];
   if (output_dims->size == 4) {
@@ -262,16 +549,17 @@ std::vector<float> Model::get_tensor_output_2dim(int idx) {
   //g_print("Output dims size %d - output size %d quant %s\n", output_dims->size, output_size, is_quantized ? "yes" : "false");
 
   if (is_quantized) {
-    uint8_t* quantized_output = interpreter_->typed_output_tensor<uint8_t>(idx);
-    int32_t zero_point = input_tensor->params.zero_point;
-    float scale = input_tensor->params.scale;
+    // Dequantize with the output params (e.g. 1/256 and 0 for the softmax), the cascade thresholds need real scores.
+    uint8_t* quantized_output = interpreter->typed_output_tensor<uint8_t>(idx);
+    int32_t zero_point = output_tensor->params.zero_point;
+    float scale = output_tensor->params.scale;
     int step =  output_dims->size == 4 ? output_dims->data[3] : 1; 
     for (int i = 0; i < output_size; i += step) {
       result.push_back((quantized_output[i] - zero_point) * scale);
     }
     
   } else {
-    float* output = interpreter_->typed_output_tensor<float>(0);
+    float* output = interpreter->typed_output_tensor<float>(idx);
     for (int i = 0; i < output_size; i++) {
       result.push_back(output[i]);
     }
@@ -279,9 +567,9 @@ std::vector<float> Model::get_tensor_output_2dim(int idx) {
   return result;
 }
 
-std::vector<uint8_t> Model::get_tensor_output_mat_quant(int idx, int channel, int* width) {
+std::vector<uint8_t> Model::get_tensor_output_mat_quant(tflite::Interpreter* interpreter, int idx, int channel, int* width) {
   std::vector<uint8_t> result;
-  TfLiteTensor* tensor = interpreter_->tensor(interpreter_->outputs()[idx]);
+  TfLiteTensor* tensor = interpreter->tensor(interpreter->outputs()[idx]);
   bool is_quantized = true;
   TfLiteIntArray* input_dims = tensor->dims;
   int intput_size = input_dims->data[1];
@@ -297,7 +585,7 @@ std::vector<uint8_t> Model::get_tensor_output_mat_quant(int idx, int channel, in
   //g_print("tensor dims size %d - output size %d quant %s\n", input_dims->size, intput_size, is_quantized ? "yes" : "false");
 
   if (is_quantized) {
-    uint8_t* quantized_input = interpreter_->typed_output_tensor<uint8_t>(idx);
+    uint8_t* quantized_input = interpreter->typed_output_tensor<uint8_t>(idx);
     int step = input_dims->data[3]; 
     for (int i = channel; i < intput_size; i += step) {
       result.push_back(quantized_input[i]);
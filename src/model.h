@@ -5,6 +5,7 @@
 #include <string>
 #include <vector>
 #include <mutex>
+#include <atomic>
 
 // Tensorflow library.
 // TODO: I don't like to put so much in the headers ... reduce to the essential.
@@ -12,13 +13,49 @@
 #include "tensorflow/contrib/lite/model.h"
 #include "tensorflow/contrib/lite/op_resolver.h"
 #include "tensorflow/contrib/lite/string_util.h"
+#include "tensorflow/contrib/lite/profiling/profiler.h"
+
+#include "trace_profiler.h"
 
 /**
  * @brief This class load and verify the model. 
  * 
+ * The model can be a cascade of models (cheap first, full last). Each frame runs
+ * the first stage and escalates to the next one only when the top-1 score is
+ * under the threshold or the margin between top-1 and top-2 is too small.
  * 
+ * In adaptive mode the models are variants of the same network at different
+ * input sizes, only one runs for each frame and it is picked from the measured
+ * latency against the target frame rate.
  */
 class Model {
+public:
+  /**
+   * @brief One model of the cascade with its own interpreter and input geometry.
+   */
+  struct Stage {
+    std::string path;
+    // File name, used in the profiler.
+    std::string name;
+    // Op-level profiler (profiling mode), it outlives the interpreter.
+    std::unique_ptr<tflite::profiling::Profiler> profiler;
+    // tensorflow lite
+    std::unique_ptr<tflite::FlatBufferModel> model;
+    std::unique_ptr<tflite::Interpreter> interpreter;
+    // Input geometry read from the input tensor.
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    // Stats (guarded by statsMtx_).
+    guint64 frames = 0;
+    guint64 escalated = 0;
+    gint64 total_us = 0;
+    // Smoothed latency (adaptive mode), 0 if never measured.
+    double latency_us = 0.0;
+    // Adaptive frame count of the last latency measure.
+    guint64 latency_frame = 0;
+  };
+
 private:
   std::string model_path_;
   std::string label_path_;
@@ -26,12 +63,30 @@ private:
   std::string tensor_name_;
   int channel_ = 0;
   // Label index/
-  int index_;
+  int index_ = -1;
   float acc_ = 0.0f;
+  // Escalate to the next stage when top-1 is under min_score_ or top-1 - top-2 is under min_margin_.
+  float min_score_ = 0.6f;
+  float min_margin_ = 0.2f;
 
-  // tensorflow lite 
-  std::unique_ptr<tflite::FlatBufferModel> model_;
-  std::unique_ptr<tflite::Interpreter> interpreter_;
+  // Cascade of models, cheap first.
+  std::vector<Stage> stages_;
+  std::mutex statsMtx_;
+  // Serialize frames from different streaming threads (server mode).
+  std::mutex inferenceMtx_;
+  // Adaptive mode: stages are sorted by input size and only active_ runs.
+  bool adaptive_ = false;
+  float target_fps_ = 0.0f;
+  // Streams sharing the model (connected clients in server mode), each one wants target_fps_.
+  int streams_ = 1;
+  double frame_budget_us_ = 0.0;
+  std::atomic<int> active_{0};
+  int frames_since_switch_ = 0;
+  guint64 adaptive_frames_ = 0;
+  guint64 switches_ = 0;
+  // Profiling mode.
+  TraceProfiler trace_;
+  bool warnedNoOpEvents_ = false;
   // Data for render the overlay.
   std::mutex overlayMtx_;
   std::vector<uint8_t> overlayFrame_;
@@ -46,7 +101,14 @@ public:
   Model() = default;
   ~Model() = default;
 
-  bool load(char const* model, char const* label, char const* tensor_name, int channel);
+  /**
+   * @brief Load the models and the labels.
+   * 
+   * @param models comma separated list of models, cheapest first.
+   * @param min_score escalate when the top-1 score is under this value.
+   * @param min_margin escalate when top-1 minus top-2 is under this value.
+   */
+  bool load(char const* models, char const* label, char const* tensor_name, int channel, float min_score, float min_margin);
 
   /**
    * @brief On new frame.
@@ -54,7 +116,59 @@ public:
    * @param buffer 
    * @param size 
    */
-  void on_new_frame(guint8* buffer, guint size);
+  void on_new_frame(guint8* buffer, guint size, int frame_width, int frame_height);
+
+  /**
+   * @brief On new frame, and copy out the label and overlay of this frame.
+   * 
+   * Safe to call from more streaming threads (one for each capture client).
+   * 
+   * @param label label and prob (can be nullptr).
+   * @param overlay overlay frame (can be nullptr).
+   * @param width overlay width (can be nullptr).
+   * @return true if the inference ran.
+   */
+  bool on_new_frame(guint8* buffer, guint size, int frame_width, int frame_height,
+                    std::string* label, std::vector<uint8_t>* overlay, int* width);
+
+  /**
+   * @brief Switch between the loaded models from the measured latency.
+   * 
+   * Call after load(), the models are sorted by input size and the biggest starts.
+   * 
+   * @param target_fps frame rate we want to keep.
+   */
+  void set_adaptive(float target_fps);
+
+  /**
+   * @brief Set how many streams share the model, the frame budget is divided between them.
+   * 
+   */
+  void set_streams(int streams);
+
+  /**
+   * @brief Get the frame geometry the model wants.
+   * 
+   * It is the input geometry of the active model in adaptive mode, the biggest
+   * input of the cascade otherwise.
+   */
+  void get_input_geometry(int* width, int* height);
+
+  /**
+   * @brief Enable profiling of the app stages and of each TFLite op, call after load().
+   * 
+   * Op-level events need tensorflow-lite and this app built with TFLITE_PROFILING_ENABLED.
+   * 
+   * @param trace_path Chrome trace JSON file.
+   * @param window_frames frames aggregated in each summary.
+   */
+  void enable_profiling(char const* trace_path, int window_frames);
+
+  /**
+   * @brief Profiler shared with the application for its own stages.
+   * 
+   */
+  TraceProfiler& trace() { return trace_; }
   
   /**
    * @brief Return current label and prob.
@@ -71,15 +185,47 @@ public:
    */
   std::vector<uint8_t> get_overlay( int* width);
 
+  /**
+   * @brief Print escalation rate and per-stage timing, then reset the counters.
+   * 
+   */
+  void print_stats();
+
+  /**
+   * @brief True if there is something to report (a cascade or adaptive mode).
+   * 
+   */
+  bool has_stats() const { return stages_.size() > 1 || adaptive_; }
+
 private:
   bool load_model(char const* model);
   bool load_labels(char const* path);
-  bool activate();
+  bool activate(Stage& stage);
+  /**
+   * @brief Run a stage on the frame.
+   * 
+   * @param index, acc, overlay, overlay_width result of this frame, set when it returns true.
+   * @return true if the result is confident enough to stop the cascade.
+   */
+  bool run_stage(Stage& stage, guint8* buffer, int image_width, int image_height, int image_channels, bool last,
+                 int* index, float* acc, std::vector<uint8_t>* overlay, int* overlay_width);
+  std::string format_label(int index, float acc);
+  /**
+   * @brief Pick the model for the next frames from the latency of the active one.
+   * 
+   */
+  void adapt(gint64 latency_us);
+  /**
+   * @brief Add the op events of the last Invoke() to the trace.
+   * 
+   * TFLite has its own clock, ops are placed from the start of Invoke().
+   */
+  void add_op_events(Stage& stage, std::string const& prefix, gint64 invoke_start_us);
   /**
    * @brief Save the tensor output scaled to float.
    * 
    */
-  std::vector<float> get_tensor_output_2dim(int idx);
+  std::vector<float> get_tensor_output_2dim(tflite::Interpreter* interpreter, int idx);
   /**
    * Save the output matrix.
    * 
@@ -89,7 +235,7 @@ private:
    * @param channel 
    * @returnstd::vector<uint8_t>>
    */
-  std::vector<uint8_t> get_tensor_output_mat_quant(int idx, int channel, int* width);
+  std::vector<uint8_t> get_tensor_output_mat_quant(tflite::Interpreter* interpreter, int idx, int channel, int* width);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "shared_result.h"
+
+// C++
+#include <atomic>
+#include <cstring>
+// C
+#include <gst/gst.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+constexpr int max_label_size = 128;
+constexpr int max_read_retries = 16;
+
+struct SharedResult::Block {
+  // Odd while the server is writing.
+  std::atomic<uint32_t> sequence;
+  // g_get_monotonic_time() of the write, it is system wide on Linux.
+  gint64 timestamp_us;
+  char label[max_label_size];
+  int32_t overlay_width;
+  uint8_t overlay[max_overlay_width * max_overlay_width];
+};
+
+SharedResult::~SharedResult() {
+  close();
+}
+
+bool SharedResult::open(char const* path) {
+  close();
+  path_ = path;
+
+  int fd = ::open(path, O_RDWR | O_CREAT, 0666);
+  if (fd < 0) {
+    GST_ERROR("Failed to open %s.", path);
+    return false;
+  }
+  // Both sides truncate to the same size, a new file is zero filled (empty result).
+  if (ftruncate(fd, sizeof(Block)) != 0) {
+    GST_ERROR("Failed to resize %s.", path);
+    ::close(fd);
+    return false;
+  }
+  void* mem = mmap(nullptr, sizeof(Block), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mem == MAP_FAILED) {
+    GST_ERROR("Failed to map %s.", path);
+    return false;
+  }
+  block_ = (Block*)mem;
+  return true;
+}
+
+void SharedResult::close() {
+  if (block_ != nullptr) {
+    munmap(block_, sizeof(Block));
+    block_ = nullptr;
+  }
+}
+
+void SharedResult::write(std::string const& label, std::vector<uint8_t> const& overlay, int width) {
+  if (block_ == nullptr) return;
+
+  uint32_t seq = block_->sequence.load(std::memory_order_relaxed);
+  block_->sequence.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  block_->timestamp_us = g_get_monotonic_time();
+  g_strlcpy(block_->label, label.c_str(), max_label_size);
+  if (width > 0 && width <= max_overlay_width && (int)overlay.size() == width * width) {
+    block_->overlay_width = width;
+    memcpy(block_->overlay, overlay.data(), overlay.size());
+  }
+  else {
+    block_->overlay_width = 0;
+  }
+
+  block_->sequence.store(seq + 2, std::memory_order_release);
+}
+
+bool SharedResult::read(std::string* label, std::vector<uint8_t>* overlay, int* width, gint64 max_age_us) {
+  if (block_ == nullptr) return false;
+
+  for (int i = 0; i < max_read_retries; i++) {
+    uint32_t seq = block_->sequence.load(std::memory_order_acquire);
+    if (seq & 1) continue;
+
+    gint64 timestamp_us = block_->timestamp_us;
+    char text[max_label_size];
+    memcpy(text, block_->label, max_label_size);
+    text[max_label_size - 1] = '\0';
+    int w = block_->overlay_width;
+    if (w < 0 || w > max_overlay_width) w = 0;
+    std::vector<uint8_t> frame(block_->overlay, block_->overlay + w * w);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (block_->sequence.load(std::memory_order_relaxed) != seq) continue;
+
+    // Nothing written yet or the server is gone.
+    if (seq == 0 || (g_get_monotonic_time() - timestamp_us) > max_age_us) {
+      return false;
+    }
+    if (label != nullptr) *label = text;
+    if (overlay != nullptr) overlay->swap(frame);
+    if (width != nullptr) *width = w;
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,64 @@
+#ifndef RT_IMG_CLASS_SHARED_RESULT_H__
+#define RT_IMG_CLASS_SHARED_RESULT_H__
+
+#include <glib.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Classification result shared between the inference server and a capture client.
+ * 
+ * The result lives in a small file mapped by both processes (MAP_SHARED). The server is the
+ * only writer, the client reads it when it draws the overlay. A sequence counter (seqlock)
+ * detects reads that overlap a write, so no lock is shared between the processes and any
+ * side can be restarted.
+ */
+class SharedResult {
+private:
+  struct Block;
+  Block* block_ = nullptr;
+  std::string path_;
+
+public:
+  // Biggest overlay we can share (MobilenetV1 Conv2d_1 is 112x112).
+  static constexpr int max_overlay_width = 112;
+
+  SharedResult() = default;
+  ~SharedResult();
+  SharedResult(SharedResult const&) = delete;
+  SharedResult& operator=(SharedResult const&) = delete;
+
+  /**
+   * @brief Map the result file, it is created if missing.
+   * 
+   * @param path file path (e.g. the capture socket path + ".result").
+   * @return true if the file is mapped.
+   */
+  bool open(char const* path);
+
+  /**
+   * @brief Unmap the result file.
+   * 
+   */
+  void close();
+
+  /**
+   * @brief Publish a new result (server side).
+   * 
+   * @param label label and prob as returned by Model::get_label().
+   * @param overlay overlay frame, dropped if bigger than max_overlay_width.
+   * @param width overlay width.
+   */
+  void write(std::string const& label, std::vector<uint8_t> const& overlay, int width);
+
+  /**
+   * @brief Read the last result (client side).
+   * 
+   * @param max_age_us results older than this are reported as missing.
+   * @return true if a fresh result was read.
+   */
+  bool read(std::string* label, std::vector<uint8_t>* overlay, int* width, gint64 max_age_us);
+};
+
+#endif
@@ -0,0 +1,153 @@
+#include "trace_profiler.h"
+
+// C++
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+// C
+#include <gst/gst.h>
+#include <unistd.h>
+
+// Small ids for the trace, one for each thread that adds spans.
+static int current_tid() {
+  static std::atomic<int> next_tid{1};
+  static thread_local int tid = next_tid++;
+  return tid;
+}
+
+// Names are tensor and file names, escape only what JSON requires.
+static std::string json_escape(std::string const& text) {
+  std::string out;
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += c;
+    }
+    else if ((unsigned char)c < 0x20) {
+      out += ' ';
+    }
+    else {
+      out += c;
+    }
+  }
+  return out;
+}
+
+void TraceProfiler::enable(char const* trace_path, int window_frames) {
+  std::lock_guard<std::mutex> guard(mtx_);
+  trace_path_ = trace_path;
+  window_frames_ = std::max(1, window_frames);
+  frames_ = 0;
+  window_start_us_ = g_get_monotonic_time();
+  events_.clear();
+  stats_.clear();
+  enabled_ = true;
+  g_print("Profiling every %d frames to %s\n", window_frames_, trace_path_.c_str());
+}
+
+void TraceProfiler::add(char const* name, char const* category, gint64 start_us, gint64 end_us, char const* op) {
+  if (!enabled_) return;
+
+  Event event;
+  event.name = name;
+  event.category = category;
+  event.op = op != nullptr ? op : "";
+  event.start_us = start_us;
+  event.duration_us = end_us - start_us;
+  event.tid = current_tid();
+
+  std::lock_guard<std::mutex> guard(mtx_);
+  std::vector<std::string> keys;
+  if (op != nullptr) {
+    keys.push_back(std::string("op: ") + op);
+    keys.push_back(std::string("layer: ") + name);
+  }
+  else {
+    keys.push_back(std::string(category) + ": " + name);
+  }
+  for (auto const& key : keys) {
+    Stat& stat = stats_[key];
+    stat.count++;
+    stat.total_us += event.duration_us;
+    stat.min_us = std::min(stat.min_us, event.duration_us);
+    stat.max_us = std::max(stat.max_us, event.duration_us);
+  }
+  events_.push_back(std::move(event));
+}
+
+void TraceProfiler::end_frame() {
+  if (!enabled_) return;
+
+  std::lock_guard<std::mutex> guard(mtx_);
+  if (++frames_ < window_frames_) return;
+  flush_window();
+}
+
+void TraceProfiler::flush() {
+  if (!enabled_) return;
+
+  std::lock_guard<std::mutex> guard(mtx_);
+  flush_window();
+}
+
+void TraceProfiler::flush_window() {
+  if (events_.empty()) return;
+
+  print_summary();
+  if (!write_trace()) {
+    GST_ERROR("Failed to write trace %s.", trace_path_.c_str());
+  }
+  else {
+    g_print("Profile: trace written to %s\n", trace_path_.c_str());
+  }
+  frames_ = 0;
+  window_start_us_ = g_get_monotonic_time();
+  events_.clear();
+  stats_.clear();
+}
+
+void TraceProfiler::print_summary() {
+  gint64 window_us = std::max<gint64>(1, g_get_monotonic_time() - window_start_us_);
+  // The last window at quit is usually partial.
+  g_print("Profile: %d frames in %.2f ms%s\n", frames_, window_us / 1000.0,
+      frames_ < window_frames_ ? " (partial window)" : "");
+  g_print("  %8s %10s %10s %10s %10s %6s  %s\n", "count", "avg ms", "min ms", "max ms", "total ms", "%", "name");
+
+  // Sorted by category (key prefix), then by total time.
+  std::vector<std::pair<std::string, Stat> > rows(stats_.begin(), stats_.end());
+  std::sort(rows.begin(), rows.end(), [](std::pair<std::string, Stat> const& a, std::pair<std::string, Stat> const& b) {
+    std::string ca = a.first.substr(0, a.first.find(':'));
+    std::string cb = b.first.substr(0, b.first.find(':'));
+    if (ca != cb) return ca < cb;
+    return a.second.total_us > b.second.total_us;
+  });
+  for (auto const& row : rows) {
+    Stat const& stat = row.second;
+    g_print("  %8" G_GUINT64_FORMAT " %10.3f %10.3f %10.3f %10.2f %6.2f  %s\n", stat.count,
+        stat.total_us / 1000.0 / stat.count, stat.min_us / 1000.0, stat.max_us / 1000.0,
+        stat.total_us / 1000.0, 100.0 * stat.total_us / window_us, row.first.c_str());
+  }
+}
+
+bool TraceProfiler::write_trace() {
+  std::ofstream out(trace_path_.c_str(), std::ios::trunc);
+  if (!out) {
+    return false;
+  }
+
+  // Complete events ("ph": "X"), timestamps are in microseconds.
+  int pid = (int)getpid();
+  out << "{\"traceEvents\":[\n";
+  for (size_t i = 0; i < events_.size(); i++) {
+    Event const& event = events_[i];
+    out << "{\"name\":\"" << json_escape(event.name) << "\",\"cat\":\"" << event.category
+        << "\",\"ph\":\"X\",\"ts\":" << event.start_us << ",\"dur\":" << event.duration_us
+        << ",\"pid\":" << pid << ",\"tid\":" << event.tid;
+    if (!event.op.empty()) {
+      out << ",\"args\":{\"op\":\"" << json_escape(event.op) << "\"}";
+    }
+    out << "}" << (i + 1 < events_.size() ? ",\n" : "\n");
+  }
+  out << "],\"displayTimeUnit\":\"ms\"}\n";
+  return out.good();
+}
@@ -0,0 +1,85 @@
+#ifndef RT_IMG_CLASS_TRACE_PROFILER_H__
+#define RT_IMG_CLASS_TRACE_PROFILER_H__
+
+#include <glib.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Collect timed spans (app stages and TFLite ops) over a window of frames.
+ * 
+ * At the end of each window it prints a summary table (per stage, per op type and
+ * per layer) and writes the spans of the window as a Chrome trace_event JSON file
+ * (open it in chrome://tracing or https://ui.perfetto.dev).
+ */
+class TraceProfiler {
+private:
+  struct Event {
+    std::string name;
+    char const* category;
+    std::string op;
+    gint64 start_us;
+    gint64 duration_us;
+    int tid;
+  };
+  struct Stat {
+    guint64 count = 0;
+    gint64 total_us = 0;
+    gint64 min_us = G_MAXINT64;
+    gint64 max_us = 0;
+  };
+
+  bool enabled_ = false;
+  std::string trace_path_;
+  int window_frames_ = 0;
+  int frames_ = 0;
+  gint64 window_start_us_ = 0;
+  std::mutex mtx_;
+  std::vector<Event> events_;
+  // Key is "category: name".
+  std::map<std::string, Stat> stats_;
+
+public:
+  TraceProfiler() = default;
+  ~TraceProfiler() = default;
+
+  /**
+   * @brief Enable the profiler.
+   * 
+   * @param trace_path Chrome trace JSON file, rewritten at the end of each window.
+   * @param window_frames frames for each window.
+   */
+  void enable(char const* trace_path, int window_frames);
+
+  bool enabled() const { return enabled_; }
+
+  /**
+   * @brief Add a span.
+   * 
+   * @param category "app", "model", "op" or "layer" (ops are added to both op and layer stats).
+   * @param op op type for "op" spans, name is the layer.
+   */
+  void add(char const* name, char const* category, gint64 start_us, gint64 end_us, char const* op = nullptr);
+
+  /**
+   * @brief Count a frame, print and write the window when it is full.
+   * 
+   */
+  void end_frame();
+
+  /**
+   * @brief Print and write what is in the current window.
+   * 
+   */
+  void flush();
+
+private:
+  // Called with mtx_ held.
+  void flush_window();
+  void print_summary();
+  bool write_trace();
+};
+
+#endif